@@ -0,0 +1,414 @@
+/*
+ * Copyright (C), 2024, Yuanlong Xu <Yono233@outlook.com>
+ * All rights reserved
+ */
+
+/*
+    MultiButtonPro 的 C++20 协程封装，需要 -std=c++20
+    以 co_await btn.next_event(on::LONG_CLICK | on::DOUBLE_CLICK) 等待事件，替代回调注册与轮询状态机
+    单线程执行器在 MTButtonTicks 产生匹配事件后恢复等待的协程；等待节点位于协程帧内，tick路径不分配内存
+    同一周期内随后产生的事件(如 PRESS_UP 之后的 LONG_CLICK)记录于定长表中，恢复的协程再次 co_await 时依次取得
+*/
+#ifndef _MULTI_BUTTON_CORO_HPP_
+#define _MULTI_BUTTON_CORO_HPP_
+
+/* Includes ------------------------------------------------------------------*/
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <initializer_list>
+#include "MultiButtonPro.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+#ifndef MT_CORO_TICK_EVENTS
+#define MT_CORO_TICK_EVENTS 8 /* 每周期记录的事件数，供恢复的协程取得同一周期内随后的事件 */
+#endif
+
+namespace mtbutton
+{
+
+/**
+ * @brief 事件订阅掩码，可按位或组合
+ */
+namespace on
+{
+constexpr uint16_t PRESS_DOWN        = 1u << ::PRESS_DOWN;
+constexpr uint16_t PRESS_UP          = 1u << ::PRESS_UP;
+constexpr uint16_t PRESS_REPEAT      = 1u << ::PRESS_REPEAT;
+constexpr uint16_t SINGLE_CLICK      = 1u << ::SINGLE_CLICK;
+constexpr uint16_t DOUBLE_CLICK      = 1u << ::DOUBLE_CLICK;
+constexpr uint16_t LONG_CLICK        = 1u << ::LONG_CLICK;
+constexpr uint16_t SHORT_PRESS_START = 1u << ::SHORT_PRESS_START;
+constexpr uint16_t LONG_PRESS_START  = 1u << ::LONG_PRESS_START;
+constexpr uint16_t LONG_PRESS_HOLD   = 1u << ::LONG_PRESS_HOLD;
+constexpr uint16_t PRESS_CANCEL      = 1u << ::PRESS_CANCEL;
+constexpr uint16_t STEP_CW           = 1u << ::STEP_CW;
+constexpr uint16_t STEP_CCW          = 1u << ::STEP_CCW;
+constexpr uint16_t ANY               = (1u << MUTLTIB_EVENT_MAX) - 1u;
+} // namespace on
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief co_await 的结果
+ */
+struct Event
+{
+    PressEvent           event  = NONE_PRESS; // 触发的事件，NONE_PRESS 表示超时
+    uint8_t              index  = 0xFF;       // when_any 中触发的等待项序号
+    MT_BUTTON           *button = nullptr;    // 触发事件的按钮
+    MT_BUTTON_EVENT_INFO info   = { };        // 事件时间信息
+
+    explicit operator bool( ) const noexcept { return event != NONE_PRESS; }
+};
+
+/**
+ * @brief 单个等待项：按钮与事件掩码
+ */
+struct Watch
+{
+    MT_BUTTON *button;
+    uint16_t   mask;
+};
+
+/**
+ * @brief 挂起中的等待节点，侵入式链接于执行器，生存期与所在协程帧一致
+ */
+class Waiter
+{
+  public:
+    Waiter(const Waiter &)            = delete;
+    Waiter &operator=(const Waiter &) = delete;
+
+    bool  await_ready( ) noexcept;
+    void  await_suspend(std::coroutine_handle<> co) noexcept;
+    Event await_resume( ) const noexcept { return result_; }
+
+    uint32_t timeout( ) const noexcept { return timeout_ms_; }
+
+  protected:
+    Waiter(const Watch *watches, uint8_t count, uint32_t timeout_ms) noexcept
+        : watches_(watches), count_(count), timeout_ms_(timeout_ms)
+    {
+    }
+    ~Waiter( );
+
+  private:
+    friend class Executor;
+
+    const Watch            *watches_;
+    uint8_t                 count_;
+    uint32_t                timeout_ms_; // 0为不超时
+    uint32_t                deadline_ = 0;
+    uint8_t                 seq_      = 0; // 唤醒本节点的事件在周期事件表中的下一位置
+    std::coroutine_handle<> co_;
+    Event                   result_;
+    Waiter                 *next_  = nullptr;
+    Waiter                **pprev_ = nullptr; // 非空表示位于等待链或就绪链中
+};
+
+/**
+ * @brief 等待单个按钮的事件，由 Button::next_event 创建
+ */
+class NextEvent : public Waiter
+{
+  public:
+    NextEvent(MT_BUTTON *button, uint16_t mask, uint32_t timeout_ms = 0) noexcept
+        : Waiter(&watch_, 1, timeout_ms), watch_{button, mask}
+    {
+    }
+    NextEvent(const NextEvent &other) noexcept : NextEvent(other.watch_.button, other.watch_.mask, other.timeout( )) {}
+
+    const Watch &watch( ) const noexcept { return watch_; }
+
+  private:
+    Watch watch_;
+};
+
+/**
+ * @brief 等待多个按钮中任一事件，由 when_any 创建，结果的 index 为触发项序号
+ */
+template <std::size_t N>
+class WhenAny : public Waiter
+{
+    static_assert(N > 0 && N < 0xFF, "when_any needs 1..254 awaitables");
+
+  public:
+    template <class... E>
+    explicit WhenAny(uint32_t timeout_ms, const E &...e) noexcept
+        : Waiter(list_, (uint8_t)N, timeout_ms), list_{e.watch( )...}
+    {
+    }
+
+  private:
+    Watch list_[N];
+};
+
+/**
+ * @brief 单线程执行器，全局唯一
+ *        MTButtonTicks 产生事件时(钩子内)仅将匹配的等待节点移入就绪链，随后由 poll 恢复协程，
+ *        避免在状态机内部重入
+ */
+class Executor
+{
+  public:
+    static Executor &instance( ) noexcept
+    {
+        static Executor exec;
+        return exec;
+    }
+
+    /**
+     * @brief 驱动按钮系统一个周期并恢复就绪的协程，替代直接调用 MTButtonTicks
+     * @param cycle 调用本函数的周期值Ms
+     */
+    void tick(uint8_t cycle) noexcept
+    {
+        MTButtonTicks(cycle);
+        poll( );
+    }
+
+    /**
+     * @brief 处理超时并恢复就绪的协程，已由其他途径调用 MTButtonTicks 时使用
+     */
+    void poll( ) noexcept
+    {
+        uint32_t now = MTButtonTimeGet( );
+        Waiter  *w   = waiting_;
+        while(w)
+        {
+            Waiter *next = w->next_;
+            if(w->timeout_ms_ && (int32_t)(now - w->deadline_) >= 0)
+            {
+                w->result_ = Event{ };
+                w->seq_    = log_num_;
+                ready(w);
+            }
+            w = next;
+        }
+
+        while(ready_head_)
+        { /* 先摘下再恢复，恢复后节点可能随协程帧一同销毁 */
+            w           = ready_head_;
+            ready_head_ = w->next_;
+            if(!ready_head_)
+                ready_tail_ = &ready_head_;
+            w->pprev_ = nullptr;
+            w->next_  = nullptr;
+            cursor_   = w->seq_;
+            resuming_ = true;
+            w->co_.resume( );
+            resuming_ = false;
+        }
+        log_num_ = 0;
+    }
+
+    Executor(const Executor &)            = delete;
+    Executor &operator=(const Executor &) = delete;
+
+  private:
+    friend class Waiter;
+
+    Executor( ) noexcept { prev_hook_ = MTButtonHookSet(&Executor::hook); }
+
+    void wait(Waiter *w) noexcept
+    {
+        w->deadline_ = MTButtonTimeGet( ) + w->timeout_ms_;
+        w->next_     = waiting_;
+        w->pprev_    = &waiting_;
+        if(waiting_)
+            waiting_->pprev_ = &w->next_;
+        waiting_ = w;
+    }
+
+    void unlink(Waiter *w) noexcept
+    {
+        if(!w->pprev_)
+            return;
+        *w->pprev_ = w->next_;
+        if(w->next_)
+            w->next_->pprev_ = w->pprev_;
+        else if(ready_tail_ == &w->next_)
+            ready_tail_ = w->pprev_;
+        w->pprev_ = nullptr;
+        w->next_  = nullptr;
+    }
+
+    /**
+     * @brief 恢复中的协程再次等待时，在本周期事件表中查找唤醒事件之后的匹配事件
+     * @return true: 已取得事件，无需挂起
+     */
+    bool replay(Waiter *w) noexcept
+    {
+        if(!resuming_)
+            return false;
+        for(uint8_t k = cursor_; k < log_num_; k++)
+        {
+            for(uint8_t i = 0; i < w->count_; i++)
+            {
+                if(w->watches_[i].button == log_[k].button && (w->watches_[i].mask & (1u << log_[k].event)))
+                {
+                    w->result_.event  = log_[k].event;
+                    w->result_.index  = i;
+                    w->result_.button = log_[k].button;
+                    w->result_.info   = log_[k].info;
+                    cursor_           = k + 1;
+                    return true;
+                }
+            }
+        }
+        cursor_ = log_num_;
+        return false;
+    }
+
+    void ready(Waiter *w) noexcept
+    {
+        unlink(w);
+        w->pprev_    = ready_tail_;
+        *ready_tail_ = w;
+        ready_tail_  = &w->next_;
+    }
+
+    static void hook(MT_BUTTON *handle, PressEvent event)
+    {
+        Executor &exec = instance( );
+        Waiter   *w    = exec.waiting_;
+
+        if(exec.log_num_ < MT_CORO_TICK_EVENTS)
+        { /* 记录供本周期恢复的协程取得；表满时随后的事件仅能唤醒已在等待的协程 */
+            Record &rec = exec.log_[exec.log_num_++];
+            rec.button  = handle;
+            rec.event   = event;
+            MTButtonEventInfoGet(handle, &rec.info);
+        }
+
+        while(w)
+        {
+            Waiter *next = w->next_;
+            for(uint8_t i = 0; i < w->count_; i++)
+            {
+                if(w->watches_[i].button == handle && (w->watches_[i].mask & (1u << event)))
+                {
+                    w->result_.event  = event;
+                    w->result_.index  = i;
+                    w->result_.button = handle;
+                    MTButtonEventInfoGet(handle, &w->result_.info);
+                    w->seq_ = exec.log_num_;
+                    exec.ready(w);
+                    break;
+                }
+            }
+            w = next;
+        }
+        if(exec.prev_hook_)
+            exec.prev_hook_(handle, event);
+    }
+
+    /**
+     * @brief 本周期产生的事件
+     */
+    struct Record
+    {
+        MT_BUTTON           *button;
+        PressEvent           event;
+        MT_BUTTON_EVENT_INFO info;
+    };
+
+    Waiter      *waiting_    = nullptr;
+    Waiter      *ready_head_ = nullptr;
+    Waiter     **ready_tail_ = &ready_head_;
+    MTButtonHook prev_hook_  = nullptr;
+    Record       log_[MT_CORO_TICK_EVENTS];
+    uint8_t      log_num_  = 0;     // 本周期已记录的事件数，poll 结束时清零
+    uint8_t      cursor_   = 0;     // 正在恢复的协程已取得的事件表位置
+    bool         resuming_ = false; // 正在 poll 中恢复协程
+};
+
+inline bool Waiter::await_ready( ) noexcept
+{
+    return Executor::instance( ).replay(this);
+}
+
+inline void Waiter::await_suspend(std::coroutine_handle<> co) noexcept
+{
+    co_ = co;
+    Executor::instance( ).wait(this);
+}
+
+inline Waiter::~Waiter( )
+{
+    Executor::instance( ).unlink(this);
+}
+
+/**
+ * @brief 等待多个按钮中的任一事件
+ * @param e 各按钮的 next_event，超时取其中最短的非零值
+ */
+template <class... E>
+WhenAny<sizeof...(E)> when_any(const E &...e) noexcept
+{
+    uint32_t timeout = 0;
+    for(uint32_t t : {e.timeout( )...})
+    {
+        if(t && (!timeout || t < timeout))
+            timeout = t;
+    }
+    return WhenAny<sizeof...(E)>(timeout, e...);
+}
+
+/**
+ * @brief 可等待的按钮对象，构造即初始化，析构时停止
+ */
+class Button : public MT_BUTTON
+{
+  public:
+    Button(uint8_t (*pin_level)(uint8_t),
+           uint8_t  active_level,
+           uint8_t  button_id, /* 基础部分 */
+           uint8_t  DebounceC,
+           uint16_t ShortT,
+           uint16_t LongT /* 拓展部分 */) noexcept
+        : MT_BUTTON( )
+    {
+        MTButtonInit(this, pin_level, active_level, button_id, DebounceC, ShortT, LongT);
+    }
+    ~Button( ) { MTButtonStop(this); }
+
+    Button(const Button &)            = delete;
+    Button &operator=(const Button &) = delete;
+
+    uint32_t start( ) noexcept { return MTButtonStart(this); }
+    void     stop( ) noexcept { MTButtonStop(this); }
+
+    /**
+     * @brief 等待本按钮的下一个匹配事件
+     * @param mask 事件掩码，见 mtbutton::on
+     * @param timeout_ms 超时时间(Ms)，0为不超时；超时结果的 event 为 NONE_PRESS
+     */
+    NextEvent next_event(uint16_t mask = on::ANY, uint32_t timeout_ms = 0) noexcept
+    {
+        return NextEvent(this, mask, timeout_ms);
+    }
+};
+
+/**
+ * @brief 即发即弃的协程任务，创建时立即运行至首个 co_await，结束后自行销毁协程帧
+ *        协程帧仅在创建任务时分配
+ */
+struct Task
+{
+    struct promise_type
+    {
+        Task               get_return_object( ) noexcept { return { }; }
+        std::suspend_never initial_suspend( ) noexcept { return { }; }
+        std::suspend_never final_suspend( ) noexcept { return { }; }
+        void               return_void( ) noexcept { }
+        void               unhandled_exception( ) noexcept { std::terminate( ); }
+    };
+};
+
+} // namespace mtbutton
+
+#endif
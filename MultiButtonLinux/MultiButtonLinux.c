@@ -0,0 +1,483 @@
+/********************************************************************************
+
+
+ **** Copyright (C), 2024, Yuanlong Xu <Yono233@outlook.com>    ****
+ **** All rights reserved                                       ****
+
+ ********************************************************************************
+ * File Name     : MultiButtonLinux.c
+ * Author        : Yuanlong Xu
+ * Date          : 2024-05-13
+ * Version       : 1.0
+********************************************************************************/
+/**************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "MultiButtonLinux.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <linux/gpio.h>
+#include <linux/input.h>
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief 输入源，将fd上的某个按键码映射到按钮ID
+ */
+typedef struct
+{
+    int      fd;
+    uint16_t code;
+    uint8_t  button_id;
+} MT_LINUX_SRC;
+
+/**
+ * @brief 文件描述符，附带不完整记录的拼接缓冲
+ */
+typedef struct
+{
+    int     fd;
+    uint8_t format;
+    uint8_t live;                                    // 仍在epoll中
+    uint8_t fill;                                    // 拼接缓冲中已有的字节数
+    uint8_t buf[sizeof(struct gpio_v2_line_event)]; // 最大的记录长度
+} MT_LINUX_FD;
+
+/**
+ * @brief 待应用的边沿，按读取顺序排列
+ */
+typedef struct
+{
+    uint64_t ns;        // 内核时间戳(CLOCK_MONOTONIC, ns)
+    uint8_t  button_id;
+    uint8_t  level;
+} MT_LINUX_EDGE;
+
+/* Private variables ---------------------------------------------------------*/
+
+static MT_LINUX_SRC src_tab[MT_LINUX_SRC_MAX]; // 输入源表
+static MT_LINUX_FD  fd_tab[MT_LINUX_FD_MAX];   // 文件描述符表
+static uint8_t      src_num   = 0;
+static uint8_t      fd_num    = 0;
+static uint8_t      fd_live   = 0;              // 仍在epoll中的输入fd数量
+static uint8_t      level_tab[256];             // 以按钮ID索引的当前电平
+static MT_LINUX_EDGE edge_tab[MT_LINUX_EDGE_MAX]; // 待应用的边沿
+static uint8_t       edge_num = 0;
+static int          epoll_fd  = -1;
+static int          timer_fd  = -1;
+static uint8_t      tick_ms   = 0;              // tick周期(Ms)
+static uint8_t      armed     = 0;              // 周期定时器是否运行
+static uint64_t     tick_ns   = 0;              // 最近一次tick对应的单调时钟值(ns)
+/* Private Constants ---------------------------------------------------------*/
+/* Private macros ------------------------------------------------------------*/
+
+#define NS_PER_MS 1000000ull
+
+/* Private function prototypes -----------------------------------------------*/
+static uint64_t MTButtonLinuxNow(void);
+static void     MTButtonLinuxSchedule(void);
+static void     MTButtonLinuxPush(uint8_t button_id, uint8_t level, uint64_t ns);
+static void     MTButtonLinuxApply(uint64_t now_ns);
+static void     MTButtonLinuxSet(uint8_t button_id, uint8_t level);
+static void     MTButtonLinuxRecord(MT_LINUX_FD *f, const uint8_t *rec);
+static void     MTButtonLinuxRead(MT_LINUX_FD *f);
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief 初始化后端，创建epoll与timerfd
+ * @param cycle tick周期值Ms，即传给MTButtonTicks的值，不可为0
+ * @return 0: 成功操作. -1: 周期无效或创建失败
+ */
+int MTButtonLinuxInit(uint8_t cycle)
+{
+    struct epoll_event ev;
+
+    if(cycle == 0)
+        return -1;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(epoll_fd < 0 || timer_fd < 0)
+    {
+        MTButtonLinuxDeinit( );
+        return -1;
+    }
+
+    ev.events  = EPOLLIN;
+    ev.data.fd = timer_fd;
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0)
+    {
+        MTButtonLinuxDeinit( );
+        return -1;
+    }
+
+    src_num = 0;
+    fd_num  = 0;
+    fd_live  = 0;
+    edge_num = 0;
+    tick_ms  = cycle;
+    armed   = 0;
+    tick_ns = MTButtonLinuxNow( );
+    memset(level_tab, 0, sizeof(level_tab));
+    return 0;
+}
+
+/**
+ * @brief 注册输入源，同一fd可多次注册不同的按键码
+ * @param fd 传递边沿记录的文件描述符，将被设为非阻塞
+ * @param format 边沿记录格式
+ * @param code 按键码(evdev)或线偏移(GPIO v2)，GPIO v1忽略
+ * @param button_id 对应的按钮ID，即MTButtonInit的button_id
+ * @param level 初始电平
+ * @return 0: 成功操作. -1: 表已满或注册失败
+ */
+int MTButtonLinuxAdd(int fd, MT_LINUX_FORMAT format, uint16_t code, uint8_t button_id, uint8_t level)
+{
+    struct epoll_event ev;
+    uint8_t            i;
+
+    if(src_num >= MT_LINUX_SRC_MAX)
+        return -1;
+
+    for(i = 0; i < fd_num; i++)
+    {
+        if(fd_tab[i].fd == fd)
+            break;
+    }
+    if(i == fd_num)
+    { /* 新的fd，加入epoll */
+        if(fd_num >= MT_LINUX_FD_MAX)
+            return -1;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        if(format == MT_LINUX_EVDEV)
+        { /* evdev默认为CLOCK_REALTIME时间戳，改为与tick栅格相同的单调时钟；非evdev的替身fd失败无妨 */
+            int clk = CLOCK_MONOTONIC;
+            ioctl(fd, EVIOCSCLOCKID, &clk);
+        }
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            return -1;
+        fd_tab[fd_num].fd     = fd;
+        fd_tab[fd_num].format = (uint8_t)format;
+        fd_tab[fd_num].live   = 1;
+        fd_tab[fd_num].fill   = 0;
+        fd_num++;
+        fd_live++;
+    }
+
+    src_tab[src_num].fd        = fd;
+    src_tab[src_num].code      = code;
+    src_tab[src_num].button_id = button_id;
+    src_num++;
+
+    level_tab[button_id] = level ? 1 : 0;
+    return 0;
+}
+
+/**
+ * @brief 按钮电平获得函数，作为MTButtonInit的pin_level参数
+ * @param button_id 按钮ID
+ * @return 截至当前tick已生效的电平0或1
+ */
+uint8_t MTButtonLinuxLevel(uint8_t button_id)
+{
+    return level_tab[button_id];
+}
+
+/**
+ * @brief 等待边沿或tick期限并驱动按钮系统，需在主循环中反复调用
+ * @param timeout_ms 最长等待时间(Ms)，-1为无限等待
+ * @return 本次驱动的tick次数. -1: 等待失败. MT_LINUX_NO_INPUT: 输入fd已全部移除且按钮空闲，可结束循环
+ */
+int MTButtonLinuxPoll(int timeout_ms)
+{
+    struct epoll_event evs[MT_LINUX_FD_MAX + 1];
+    uint64_t           expir = 0;
+    int                n, i;
+    uint8_t            j;
+
+    if(fd_live == 0 && edge_num == 0 && MTButtonIsIdle( ))
+        return MT_LINUX_NO_INPUT; /* 无输入且无进行中的流程，等待将永久阻塞 */
+
+    MTButtonLinuxSchedule( );
+
+    n = epoll_wait(epoll_fd, evs, MT_LINUX_FD_MAX + 1, timeout_ms);
+    if(n < 0)
+        return (errno == EINTR) ? 0 : -1;
+
+    for(i = 0; i < n; i++)
+    {
+        if(evs[i].data.fd == timer_fd)
+        {
+            if(read(timer_fd, &expir, sizeof(expir)) != sizeof(expir))
+                expir = 0;
+            continue;
+        }
+        for(j = 0; j < fd_num; j++)
+        {
+            if(fd_tab[j].fd == evs[i].data.fd)
+                MTButtonLinuxRead(&fd_tab[j]);
+        }
+    }
+
+    /* 逐个驱动到期的tick，补齐错过的周期；每个tick前应用时间戳不晚于该tick的边沿 */
+    for(i = 0; i < (int)expir; i++)
+    {
+        tick_ns += tick_ms * NS_PER_MS;
+        MTButtonLinuxApply(tick_ns);
+        MTButtonTicks(tick_ms);
+    }
+
+    MTButtonLinuxSchedule( );
+    return (int)expir;
+}
+
+/**
+ * @brief 关闭后端创建的epoll与timerfd，注册的输入fd由调用者关闭
+ */
+void MTButtonLinuxDeinit(void)
+{
+    if(timer_fd >= 0)
+        close(timer_fd);
+    if(epoll_fd >= 0)
+        close(epoll_fd);
+    timer_fd = -1;
+    epoll_fd = -1;
+    src_num  = 0;
+    fd_num   = 0;
+    fd_live  = 0;
+    edge_num = 0;
+}
+
+/**
+ * @brief 获得单调时钟值
+ * @return 单调时钟值(ns)
+ */
+static uint64_t MTButtonLinuxNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 依据按钮是否空闲启停周期定时器
+ *        空闲时停止定时器阻塞等待边沿；恢复时按原tick栅格对齐，并将空闲期省略的tick计入时基
+ *        省略的tick仅计至最早的待应用边沿，其后的tick由定时器补齐，使延迟读取的边沿仍在所属tick生效
+ */
+static void MTButtonLinuxSchedule(void)
+{
+    struct itimerspec its;
+    uint8_t           idle = MTButtonIsIdle( ) && edge_num == 0;
+    uint64_t          now, limit, missed, first;
+    uint8_t           i;
+
+    if(armed != idle)
+        return; /* 状态未变 */
+
+    memset(&its, 0, sizeof(its));
+    if(idle)
+    {
+        timerfd_settime(timer_fd, 0, &its, NULL);
+        armed = 0;
+        return;
+    }
+
+    now   = MTButtonLinuxNow( );
+    limit = now;
+    for(i = 0; i < edge_num; i++)
+    {
+        if(edge_tab[i].ns < limit)
+            limit = edge_tab[i].ns;
+    }
+    missed = (limit > tick_ns) ? (limit - tick_ns) / (tick_ms * NS_PER_MS) : 0;
+    if(missed > 0)
+    { /* 空闲期的tick不影响状态机，仅推进时基 */
+        MTButtonTimeAdvance((uint32_t)(missed * tick_ms));
+        tick_ns += missed * tick_ms * NS_PER_MS;
+    }
+    first                     = tick_ns + tick_ms * NS_PER_MS;
+    its.it_value.tv_sec       = (time_t)(first / 1000000000ull);
+    its.it_value.tv_nsec      = (long)(first % 1000000000ull);
+    its.it_interval.tv_sec    = (time_t)(tick_ms / 1000u);
+    its.it_interval.tv_nsec   = (long)(tick_ms % 1000u) * (long)NS_PER_MS;
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    armed = 1;
+}
+
+/**
+ * @brief 解析一条完整的边沿记录并更新对应按钮的电平
+ * @param f 文件描述符对象
+ * @param rec 记录起始地址
+ */
+static void MTButtonLinuxRecord(MT_LINUX_FD *f, const uint8_t *rec)
+{
+    uint16_t code  = 0;
+    uint8_t  level = 0;
+    uint64_t ns    = 0;
+    uint8_t  i;
+
+    switch(f->format)
+    {
+    case MT_LINUX_GPIO_V1: {
+        struct gpioevent_data e;
+        memcpy(&e, rec, sizeof(e));
+        level = (e.id == GPIOEVENT_EVENT_RISING_EDGE);
+        ns    = e.timestamp;
+        break;
+    }
+    case MT_LINUX_GPIO_V2: {
+        struct gpio_v2_line_event e;
+        memcpy(&e, rec, sizeof(e));
+        code  = (uint16_t)e.offset;
+        level = (e.id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+        ns    = e.timestamp_ns;
+        break;
+    }
+    case MT_LINUX_EVDEV: {
+        struct input_event e;
+        memcpy(&e, rec, sizeof(e));
+        if(e.type != EV_KEY)
+            return; /* EV_SYN等非按键记录 */
+        code  = e.code;
+        level = (e.value != 0); /* 1按下 2自动重复 0释放 */
+        ns    = (uint64_t)e.input_event_sec * 1000000000ull + (uint64_t)e.input_event_usec * 1000ull;
+        break;
+    }
+    default:
+        return;
+    }
+
+    for(i = 0; i < src_num; i++)
+    {
+        if(src_tab[i].fd != f->fd)
+            continue;
+        if(f->format != MT_LINUX_GPIO_V1 && src_tab[i].code != code)
+            continue;
+        MTButtonLinuxPush(src_tab[i].button_id, level, ns);
+    }
+}
+
+/**
+ * @brief 边沿加入待应用队列
+ *        无时间戳、非单调时钟(晚于当前时刻)的记录以读取时刻为准；队列满时最早的边沿立即生效
+ * @param button_id 按钮ID
+ * @param level 边沿后的电平
+ * @param ns 内核时间戳(ns)
+ */
+static void MTButtonLinuxPush(uint8_t button_id, uint8_t level, uint64_t ns)
+{
+    uint64_t now = MTButtonLinuxNow( );
+
+    if(ns == 0 || ns > now)
+        ns = now;
+
+    if(edge_num >= MT_LINUX_EDGE_MAX)
+    {
+        MTButtonLinuxSet(edge_tab[0].button_id, edge_tab[0].level);
+        memmove(&edge_tab[0], &edge_tab[1], sizeof(edge_tab[0]) * (MT_LINUX_EDGE_MAX - 1));
+        edge_num--;
+    }
+    edge_tab[edge_num].ns        = ns;
+    edge_tab[edge_num].button_id = button_id;
+    edge_tab[edge_num].level     = level;
+    edge_num++;
+}
+
+/**
+ * @brief 应用时间戳不晚于指定时刻的边沿，每个按钮每次至多应用一个，
+ *        使同一次读取中的按下与释放分属不同tick而不被合并
+ * @param now_ns 本次tick对应的单调时钟值(ns)
+ */
+static void MTButtonLinuxApply(uint64_t now_ns)
+{
+    uint8_t seen[256 / 8];
+    uint8_t i, k = 0;
+    uint8_t bit;
+
+    memset(seen, 0, sizeof(seen));
+    for(i = 0; i < edge_num; i++)
+    {
+        bit = (uint8_t)(1u << (edge_tab[i].button_id & 7));
+        if(!(seen[edge_tab[i].button_id >> 3] & bit) && edge_tab[i].ns <= now_ns)
+            MTButtonLinuxSet(edge_tab[i].button_id, edge_tab[i].level);
+        else
+            edge_tab[k++] = edge_tab[i]; /* 未到期，或同一按钮之前的边沿尚未应用 */
+        seen[edge_tab[i].button_id >> 3] |= bit;
+    }
+    edge_num = k;
+}
+
+/**
+ * @brief 读空文件描述符，按记录长度拼接并逐条解析
+ * @param f 文件描述符对象
+ */
+static void MTButtonLinuxRead(MT_LINUX_FD *f)
+{
+    uint8_t raw[512];
+    uint8_t size;
+    ssize_t len, pos, cpy;
+
+    switch(f->format)
+    {
+    case MT_LINUX_GPIO_V1:
+        size = sizeof(struct gpioevent_data);
+        break;
+    case MT_LINUX_GPIO_V2:
+        size = sizeof(struct gpio_v2_line_event);
+        break;
+    default:
+        size = sizeof(struct input_event);
+        break;
+    }
+
+    for(;;)
+    {
+        len = read(f->fd, raw, sizeof(raw));
+        if(len < 0 && errno == EINTR)
+            continue;
+        if(len < 0 && errno == EAGAIN)
+            return; /* 已读空 */
+        if(len <= 0)
+        { /* 对端关闭或设备移除(如ENODEV)，移出epoll避免电平触发反复唤醒 */
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, f->fd, NULL);
+            if(f->live)
+                fd_live--;
+            f->live = 0;
+            return;
+        }
+
+        for(pos = 0; pos < len; pos += cpy)
+        {
+            cpy = size - f->fill;
+            if(cpy > len - pos)
+                cpy = len - pos;
+            memcpy(&f->buf[f->fill], &raw[pos], (size_t)cpy);
+            f->fill += (uint8_t)cpy;
+            if(f->fill == size)
+            {
+                MTButtonLinuxRecord(f, f->buf);
+                f->fill = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 更新按钮电平，电平变化时通知对应按钮(时间轮模式下空闲按钮仅在通知后被处理)
+ * @param button_id 按钮ID
+ * @param level 电平
+ */
+static void MTButtonLinuxSet(uint8_t button_id, uint8_t level)
+{
+    if(level_tab[button_id] == level)
+        return;
+    level_tab[button_id] = level;
+    MTButtonNotifyId(button_id);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C), 2024, Yuanlong Xu <Yono233@outlook.com> 
+ * All rights reserved
+ */
+
+/*
+    MultiButtonPro 的 Linux 主机后端
+    从文件描述符读取边沿记录(GPIO字符设备行事件或evdev input_event)，借助 epoll 与 timerfd 等待，
+    仅在边沿到来或存在进行中的消抖/按键流程时驱动 MTButtonTicks，全部按钮空闲时阻塞休眠
+    边沿按内核时间戳在其所属的 tick 生效，事件时间戳精度为 tick 周期；读取延迟不影响判定
+*/
+#ifndef _MULTI_BUTTON_LINUX_H_
+#define _MULTI_BUTTON_LINUX_H_
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "MultiButtonPro.h"
+/* Exported constants --------------------------------------------------------*/
+
+#define MT_LINUX_SRC_MAX 32 /* 最大输入源数量(一个fd上的多个按键码各计一个) */
+#define MT_LINUX_FD_MAX  16 /* 最大文件描述符数量 */
+#define MT_LINUX_EDGE_MAX 64 /* 待应用的边沿记录数量，满时最早的记录立即生效 */
+
+#define MT_LINUX_NO_INPUT (-2) /* MTButtonLinuxPoll返回值：输入fd已全部关闭或移除且按钮空闲，不会再有事件 */
+
+/* Exported macros -----------------------------------------------------------*/
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief 文件描述符传递的边沿记录格式
+ */
+typedef enum
+{
+    MT_LINUX_GPIO_V1 = 0, // struct gpioevent_data，一个fd对应一条线，code忽略
+    MT_LINUX_GPIO_V2,     // struct gpio_v2_line_event，code为线偏移(offset)
+    MT_LINUX_EVDEV,       // struct input_event，仅处理EV_KEY，code为按键码
+} MT_LINUX_FORMAT;
+
+/* Exported variables ---------------------------------------------------------*/
+/* Exported functions ---------------------------------------------------------*/
+
+extern int     MTButtonLinuxInit(uint8_t cycle);
+extern int     MTButtonLinuxAdd(int fd, MT_LINUX_FORMAT format, uint16_t code, uint8_t button_id, uint8_t level);
+extern uint8_t MTButtonLinuxLevel(uint8_t button_id);
+extern int     MTButtonLinuxPoll(int timeout_ms);
+extern void    MTButtonLinuxDeinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,22 +17,47 @@
 /* Private types -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 
-static MT_BUTTON *head_handle = NULL; // 按钮对象链头指针
+/* 正交解码表，以 (上次AB<<2)|本次AB 索引；A相超前为顺时针，双相同时跳变视为毛刺记0 */
+static const int8_t encoder_table[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+
+static MT_BUTTON   *head_handle = NULL; // 按钮对象链头指针
+static uint32_t     sys_ms      = 0;    // 按钮系统时基(Ms)，由MTButtonTicks累加
+static uint32_t     sample_ms   = 0;    // 正在处理的采样对应的时基(Ms)，批量输入时早于sys_ms
+static MTButtonHook event_hook  = NULL; // 全局事件钩子
+
+static MT_BUTTON_SINK *event_sink    = NULL; // 组级事件汇聚
+static uint16_t        sink_num      = 0;    // 汇聚缓冲中的记录数
+static uint32_t        sink_first_ms = 0;    // 汇聚缓冲首条记录写入时的时基(Ms)
+#if MT_BUTTON_USE_WHEEL
+static MT_BUTTON *wheel_slot[MT_BUTTON_WHEEL_SLOTS]; // 时间轮槽
+static MT_BUTTON *wheel_running;                     // 哨兵，正在处理的按钮wheel_pprev指向此处
+static uint32_t   wheel_now = 0;                     // 当前tick序号
+#endif
 /* Private Constants ---------------------------------------------------------*/
 /* Private macros ------------------------------------------------------------*/
 
 #define PRESS_REPEAT_MAX_NUM 15 /* 重复计数器的最大值 */
 
 /**
- * @brief 检查事件函数并且触发事件处理
+ * @brief 记录事件并且触发事件处理
  * @param ev 事件值
  */
-#define EVENT_CB(ev)   \
-    if(handle->cb[ev]) \
-    handle->cb[ev]((void *)handle)
+#define EVENT_CB(ev) MTButtonEventEmit(handle, ev)
 
 /* Private function prototypes -----------------------------------------------*/
-static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle);
+static void MTButtonEventEmit(MT_BUTTON *handle, PressEvent event);
+static void MTButtonHandler(MT_BUTTON *handle, uint8_t read_gpio_level, uint16_t cycle);
+static void MTButtonDebounceTune(MT_BUTTON *handle, uint32_t edge_ms);
+static void MTEncoderHandler(MT_ENCODER *enc);
+static void MTButtonProcess(MT_BUTTON *target, uint16_t cycle);
+static void MTButtonSinkPut(MT_BUTTON *handle, PressEvent event);
+static void MTButtonSinkPoll(void);
+#if MT_BUTTON_USE_WHEEL
+static void     MTButtonWheelUnlink(MT_BUTTON *handle);
+static void     MTButtonWheelInsert(MT_BUTTON *handle, uint32_t wait);
+static uint32_t MTButtonWheelWait(MT_BUTTON *handle, uint8_t cycle);
+static void     MTButtonWheelRun(uint8_t cycle);
+#endif
 /* Private functions ---------------------------------------------------------*/
 
 /**
@@ -41,7 +66,7 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle);
  * @param pin_level 获取按钮值的函数
  * @param active_level 按钮按下时的按钮值
  * @param button_id 按钮ID
- * @param DebounceC 消抖变换确立值判断时间值(周期数)，最大范围见定义
+ * @param DebounceC 消抖变换确立值判断时间值(周期数)，超过MT_BUTTON_DEBOUNCE_MAX时取上限
  * @param ShortT 短按判断时间值(ms)
  * @param button_id 长按判断时间值(ms)
  */
@@ -70,7 +95,7 @@ void MTButtonInit(MT_BUTTON *handle,
     handle->active_level        = active_level;
     handle->button_id           = button_id;
 
-    handle->ConfMs.DebounceCnts = DebounceC;
+    handle->ConfMs.DebounceCnts = (DebounceC > MT_BUTTON_DEBOUNCE_MAX) ? MT_BUTTON_DEBOUNCE_MAX : DebounceC;
     handle->ConfMs.ShortTicks   = ShortT;
     handle->ConfMs.LongTicks    = LongT;
 }
@@ -86,6 +111,18 @@ void MTButtonAttach(MT_BUTTON *handle, PressEvent event, BtnCallback cb)
     handle->cb[event] = cb;
 }
 
+/**
+ * @brief 设置全局事件钩子，任一按钮产生事件时在其回调之后调用
+ * @param hook 钩子函数指针，NULL为取消
+ * @return 之前设置的钩子，便于链式调用
+ */
+MTButtonHook MTButtonHookSet(MTButtonHook hook)
+{
+    MTButtonHook prev = event_hook;
+    event_hook        = hook;
+    return prev;
+}
+
 /**
  * @brief 获得当前的按钮事件
  * @param handle 按钮对象指针
@@ -97,14 +134,178 @@ PressEvent MTButtonEventGet(MT_BUTTON *handle)
 }
 
 /**
- * @brief 按钮驱动核心，驱动状态机
+ * @brief 获得当前按钮事件的时间信息，可在事件回调中调用
  * @param handle 按钮对象指针
- * @param cycle 调用本函数的周期值Ms
+ * @param info 时间信息的输出
+ */
+void MTButtonEventInfoGet(MT_BUTTON *handle, MT_BUTTON_EVENT_INFO *info)
+{
+    info->TimeMs   = handle->event_ms;
+    info->Event    = handle->event;
+    info->Repeat   = handle->repeat;
+    info->ButtonId = handle->button_id;
+
+    switch(handle->event)
+    {
+    case PRESS_UP:
+    case SINGLE_CLICK:
+    case DOUBLE_CLICK:
+    case LONG_CLICK: /* 已释放，持续时间为完整的按下时长 */
+        info->DurationMs = handle->release_ms - handle->press_ms;
+        break;
+    case PRESS_DOWN:
+    case PRESS_CANCEL:
+    case STEP_CW:
+    case STEP_CCW:
+    case NONE_PRESS:
+        info->DurationMs = 0;
+        break;
+    default: /* 按下期间，持续时间为至事件时刻的时长 */
+        info->DurationMs = handle->event_ms - handle->press_ms;
+        break;
+    }
+}
+
+/**
+ * @brief 获得按钮系统时基，即MTButtonTicks累计的周期值
+ * @return 时基(Ms)
+ */
+uint32_t MTButtonTimeGet(void)
+{
+    return sys_ms;
+}
+
+/**
+ * @brief 推进按钮系统时基而不驱动状态机，用于跳过全部按钮空闲期间省略的tick
+ * @param ms 推进的时间值(Ms)
+ */
+void MTButtonTimeAdvance(uint32_t ms)
+{
+    sys_ms += ms;
+}
+
+/**
+ * @brief 记录事件寄存器与时间戳，并调用注册的回调函数
+ * @param handle 按钮对象指针
+ * @param event 事件值
+ */
+static void MTButtonEventEmit(MT_BUTTON *handle, PressEvent event)
+{
+    handle->event   = (uint8_t)event;
+    handle->emitted = 1;
+
+    switch(event)
+    {
+    case PRESS_DOWN: /* 按下边沿类事件，提前上报时即为首个按下采样 */
+        handle->event_ms = handle->eager_down ? sample_ms : handle->press_ms;
+        break;
+    case PRESS_REPEAT:
+        handle->event_ms = handle->press_ms;
+        break;
+    case PRESS_UP:
+    case LONG_CLICK: /* 释放边沿类事件 */
+        handle->event_ms = handle->release_ms;
+        break;
+    default: /* 阈值类事件，发生在本次tick */
+        handle->event_ms = sample_ms;
+        break;
+    }
+
+    if(handle->cb[event])
+        handle->cb[event]((void *)handle);
+    if(event_hook)
+        event_hook(handle, event);
+    if(event_sink && (event_sink->Mask & MT_BUTTON_EVENT_MASK(event)))
+        MTButtonSinkPut(handle, event);
+}
+
+/**
+ * @brief 设置组级事件汇聚，替代在每个按钮的各事件上注册相同的转发回调
+ *        sink指向的配置需在使用期间保持有效；切换或取消时先投递已缓存的记录
+ * @param sink 汇聚配置，NULL为取消
+ */
+void MTButtonSinkSet(MT_BUTTON_SINK *sink)
+{
+    MTButtonSinkFlush( );
+    if(sink && (sink->Buf == NULL || sink->Size == 0 || sink->Deliver == NULL))
+        sink = NULL;
+    event_sink = sink;
+}
+
+/**
+ * @brief 立即投递汇聚缓冲中已缓存的记录
+ */
+void MTButtonSinkFlush(void)
+{
+    uint16_t num = sink_num;
+
+    if(event_sink == NULL || num == 0)
+        return;
+    sink_num = 0;
+    event_sink->Deliver(event_sink->Buf, num);
+}
+
+/**
+ * @brief 将事件写入汇聚缓冲，需合并的事件累加到同一按钮最近一条同类记录上
+ * @param handle 按钮对象指针
+ * @param event 事件值
+ */
+static void MTButtonSinkPut(MT_BUTTON *handle, PressEvent event)
+{
+    MT_BUTTON_EVENT_INFO info;
+    MT_BUTTON_RECORD    *rec;
+    uint16_t             i;
+
+    MTButtonEventInfoGet(handle, &info);
+
+    if(event_sink->CoalesceMask & MT_BUTTON_EVENT_MASK(event))
+    {
+        for(i = sink_num; i > 0; i--)
+        { /* 仅合并到本按钮最近的一条记录，保持批内事件顺序 */
+            rec = &event_sink->Buf[i - 1];
+            if(rec->ButtonId != handle->button_id)
+                continue;
+            if(rec->Event == (uint8_t)event)
+            {
+                if(rec->Count != 0xFFFF)
+                    rec->Count++;
+                rec->DurationMs = info.DurationMs;
+                return;
+            }
+            break;
+        }
+    }
+
+    if(sink_num >= event_sink->Size)
+        MTButtonSinkFlush( );
+    if(sink_num == 0)
+        sink_first_ms = sys_ms;
+
+    rec             = &event_sink->Buf[sink_num++];
+    rec->TimeMs     = info.TimeMs;
+    rec->DurationMs = info.DurationMs;
+    rec->Count      = 1;
+    rec->Event      = (uint8_t)event;
+    rec->ButtonId   = handle->button_id;
+}
+
+/**
+ * @brief 批量窗口到期时投递汇聚缓冲，在每次驱动结束时调用
  */
-static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
+static void MTButtonSinkPoll(void)
 {
-    uint8_t read_gpio_level = handle->hal_button_Level(handle->button_id);
+    if(event_sink && sink_num && sys_ms - sink_first_ms >= event_sink->WindowMs)
+        MTButtonSinkFlush( );
+}
 
+/**
+ * @brief 按钮驱动核心，驱动状态机
+ * @param handle 按钮对象指针
+ * @param read_gpio_level 本次采样的按钮电平
+ * @param cycle 距上次处理的时间值Ms，时间轮模式下可为多个周期
+ */
+static void MTButtonHandler(MT_BUTTON *handle, uint8_t read_gpio_level, uint16_t cycle)
+{
     /* tick计数器进行 */
     if((handle->state) > 0)
         handle->ticks += cycle;
@@ -113,14 +314,44 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
     if(read_gpio_level != handle->button_level)
     {
         if(++(handle->debounce_cnt) >= handle->ConfMs.DebounceCnts)
-        { /* 连续变化达阈值，切换按钮状态 */
+        { /* 连续变化达阈值，切换按钮状态，边沿时刻回溯至首个变化周期 */
+            uint32_t edge_ms = sample_ms;
+            if(handle->ConfMs.DebounceCnts > 1)
+                edge_ms -= (uint32_t)(handle->ConfMs.DebounceCnts - 1) * cycle;
+
+            if(handle->adapt_en)
+                MTButtonDebounceTune(handle, edge_ms);
+
+            if(read_gpio_level == handle->active_level)
+                handle->press_ms = edge_ms;
+            else
+                handle->release_ms = edge_ms;
+
             handle->button_level = read_gpio_level;
             handle->debounce_cnt = 0;
         }
+        else if(handle->debounce_cnt == 1 && handle->ConfMs.EagerPress && read_gpio_level == handle->active_level &&
+                (handle->state == 0 ||
+                 (handle->state == 2 &&
+                  handle->ticks + (uint32_t)(handle->ConfMs.DebounceCnts - 2) * cycle <= handle->ConfMs.ShortTicks)))
+        { /* 提前上报按下，状态机保持不变，待消抖确立后继续
+             状态2中连击窗口可能在消抖确立前结束(先上报上一次的单击/双击)时不提前上报，保持事件顺序 */
+            if(handle->state == 0)
+                handle->repeat = 1;
+            handle->eager_down = 1;
+            EVENT_CB(PRESS_DOWN);
+        }
     }
     else
     {
+        if(handle->debounce_cnt > handle->bounce_max) /* 记录被滤除的抖动长度 */
+            handle->bounce_max = handle->debounce_cnt;
         handle->debounce_cnt = 0;
+        if(handle->eager_down)
+        { /* 提前上报的按下未能保持，撤销 */
+            handle->eager_down = 0;
+            EVENT_CB(PRESS_CANCEL);
+        }
     }
 
     /* 状态机驱动进行 */
@@ -129,14 +360,21 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
     case 0:
         if(handle->button_level == handle->active_level)
         { /* 按键按下 */
-            handle->event = (uint8_t)PRESS_DOWN;
-            EVENT_CB(PRESS_DOWN);
-            handle->ticks  = 0;
             handle->repeat = 1;
+            if(handle->eager_down)
+            { /* 已提前上报，仅更新事件寄存器 */
+                handle->eager_down = 0;
+                handle->event      = (uint8_t)PRESS_DOWN;
+            }
+            else
+            {
+                EVENT_CB(PRESS_DOWN);
+            }
+            handle->ticks  = 0;
             handle->state  = 1;
         }
-        else
-        {
+        else if(!handle->emitted && !handle->eager_down)
+        { /* 本次未产生事件且无待确立的提前按下，轮询方可看到刚产生的PRESS_DOWN/PRESS_CANCEL */
             handle->event = (uint8_t)NONE_PRESS;
         }
         break;
@@ -144,20 +382,17 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
     case 1:
         if(handle->button_level != handle->active_level)
         { /* 按键释放 */
-            handle->event = (uint8_t)PRESS_UP;
             EVENT_CB(PRESS_UP);
             handle->ticks = 0;
             handle->state = 2;
         }
         else if(handle->ticks > handle->ConfMs.LongTicks)
         { /* 长按达成事件触发 */
-            handle->event = (uint8_t)LONG_PRESS_START;
             EVENT_CB(LONG_PRESS_START);
             handle->state = 5;
         }
         else if(handle->ticks == handle->ConfMs.ShortTicks)
         { /* 短按达成事件触发 */
-            handle->event = (uint8_t)SHORT_PRESS_START;
             EVENT_CB(SHORT_PRESS_START);
         }
 
@@ -166,13 +401,19 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
     case 2:
         if(handle->button_level == handle->active_level)
         { /* 按键按下 */
-            handle->event = (uint8_t)PRESS_DOWN;
-            EVENT_CB(PRESS_DOWN);
+            if(handle->eager_down)
+            { /* 已提前上报，仅更新事件寄存器 */
+                handle->eager_down = 0;
+                handle->event      = (uint8_t)PRESS_DOWN;
+            }
+            else
+            {
+                EVENT_CB(PRESS_DOWN);
+            }
             if(handle->repeat != PRESS_REPEAT_MAX_NUM)
             {
                 handle->repeat++;
             }
-            handle->event = (uint8_t)PRESS_REPEAT;
             EVENT_CB(PRESS_REPEAT);
             handle->ticks = 0;
             handle->state = 3;
@@ -181,12 +422,10 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
         { /* 达短按阈值 */
             if(handle->repeat == 1)
             {
-                handle->event = (uint8_t)SINGLE_CLICK;
                 EVENT_CB(SINGLE_CLICK);
             }
             else if(handle->repeat == 2)
             {
-                handle->event = (uint8_t)DOUBLE_CLICK;
                 EVENT_CB(DOUBLE_CLICK); // repeat hit
             }
 
@@ -197,7 +436,6 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
     case 3:
         if(handle->button_level != handle->active_level)
         { /* 按键释放 */
-            handle->event = (uint8_t)PRESS_UP;
             EVENT_CB(PRESS_UP);
             if(handle->ticks < handle->ConfMs.ShortTicks)
             {
@@ -218,14 +456,11 @@ static void MTButtonHandler(MT_BUTTON *handle, uint8_t cycle)
     case 5:
         if(handle->button_level == handle->active_level)
         { /* 按键按下 */
-            handle->event = (uint8_t)LONG_PRESS_HOLD;
             EVENT_CB(LONG_PRESS_HOLD);
         }
         else
         {
-            handle->event = (uint8_t)PRESS_UP;
             EVENT_CB(PRESS_UP);
-            handle->event = (uint8_t)LONG_CLICK;
             EVENT_CB(LONG_CLICK);
             handle->state = 0; //reset
         }
@@ -251,6 +486,10 @@ uint32_t MTButtonStart(MT_BUTTON *handle)
     }
     handle->next = head_handle;
     head_handle  = handle;
+#if MT_BUTTON_USE_WHEEL
+    handle->wheel_ms = sys_ms;
+    MTButtonWheelInsert(handle, 1); /* 下次tick采样初始电平 */
+#endif
     return 0;
 }
 
@@ -267,6 +506,9 @@ void MTButtonStop(MT_BUTTON *handle)
         if(entry == handle)
         {
             *curr = entry->next;
+#if MT_BUTTON_USE_WHEEL
+            MTButtonWheelUnlink(handle);
+#endif
             return;
         }
         else
@@ -281,10 +523,688 @@ void MTButtonStop(MT_BUTTON *handle)
  * @param cycle 调用本函数的周期值Ms
  */
 void MTButtonTicks(uint8_t cycle)
+{
+    sys_ms += cycle;
+    sample_ms = sys_ms;
+#if MT_BUTTON_USE_WHEEL
+    MTButtonWheelRun(cycle);
+#else
+    MT_BUTTON *target;
+    for(target = head_handle; target; target = target->next)
+    {
+        MTButtonProcess(target, cycle);
+    }
+#endif
+    MTButtonSinkPoll( );
+}
+
+/**
+ * @brief 处理工作列表中的一个对象，包括编码器部分与按钮部分
+ * @param target 按钮对象指针
+ * @param cycle 距上次处理的时间值Ms
+ */
+static void MTButtonProcess(MT_BUTTON *target, uint16_t cycle)
+{
+    target->emitted = 0;
+    if(target->is_encoder)
+        MTEncoderHandler((MT_ENCODER *)target);
+    if(target->hal_button_Level)
+        MTButtonHandler(target, target->hal_button_Level(target->button_id), cycle);
+    else if(!target->emitted)
+        target->event = (uint8_t)NONE_PRESS; /* 无推压开关的编码器，无步进时回到空闲，同向的连续步进可被轮询区分 */
+}
+
+/**
+ * @brief 初始化编码器对象，之后以MTButtonStart(&enc->Btn)加入工作列表
+ * @param enc 编码器对象指针
+ * @param ab_level A/B相电平获得函数，返回(A<<1)|B；为NULL时仅由MTEncoderSample/MTEncoderFeedSamples输入
+ * @param pin_level 推压开关电平获得函数，无推压开关时为NULL
+ * @param active_level 推压开关按下时的电平
+ * @param encoder_id 编码器ID，传给两个电平获得函数
+ * @param StepsPerDetent 每格的四分之一步数，常见为4，也可为2或1
+ * @param DebounceC 推压开关消抖周期数
+ * @param ShortT 推压开关短按判断时间值(ms)
+ * @param LongT 推压开关长按判断时间值(ms)
+ */
+void MTEncoderInit(MT_ENCODER *enc,
+                   uint8_t (*ab_level)(uint8_t),
+                   uint8_t (*pin_level)(uint8_t),
+                   uint8_t  active_level,
+                   uint8_t  encoder_id,
+                   uint8_t  StepsPerDetent, /* 基础部分 */
+                   uint8_t  DebounceC,
+                   uint16_t ShortT,
+                   uint16_t LongT /* 推压开关部分 */)
+{
+    MTButtonInit(&enc->Btn, pin_level, active_level, encoder_id, DebounceC, ShortT, LongT);
+    enc->Btn.is_encoder = 1;
+
+    if(StepsPerDetent != 1 && StepsPerDetent != 2)
+        StepsPerDetent = 4;
+
+    enc->hal_encoder_AB = ab_level;
+    enc->qstep          = 0;
+    enc->qstep_done     = 0;
+    enc->ab_last        = ab_level ? (ab_level(encoder_id) & 0x03) : 0;
+    enc->detent         = StepsPerDetent;
+    enc->accel_delta    = 0;
+    enc->velocity       = 0;
+    enc->position       = 0;
+    enc->step_ms        = sys_ms;
+}
+
+/**
+ * @brief 输入一次A/B相采样并解码，可在高速定时器或引脚中断中调用以免低扫描率下丢步
+ *        仅累计四分之一步，步进事件在下次MTButtonTicks中上报；此时初始化的ab_level应为NULL，避免与tick同时采样
+ * @param enc 编码器对象指针
+ * @param ab A/B相电平，(A<<1)|B
+ */
+void MTEncoderSample(MT_ENCODER *enc, uint8_t ab)
+{
+    ab &= 0x03;
+    enc->qstep += encoder_table[(enc->ab_last << 2) | ab];
+    enc->ab_last = ab;
+}
+
+/**
+ * @brief 批量输入一段高速采样(如定时器+DMA捕获的A/B相)，解码后在下次MTButtonTicks中上报步进
+ * @param enc 编码器对象指针
+ * @param ab 紧凑排列的A/B相采样，第i个采样为ab[i/4]的bit(2*(i%4)+1..2*(i%4))，格式同(A<<1)|B
+ * @param count 采样个数
+ */
+void MTEncoderFeedSamples(MT_ENCODER *enc, const uint8_t *ab, uint16_t count)
+{
+    uint16_t i;
+    uint8_t  last = enc->ab_last;
+    uint8_t  cur;
+    int16_t  qstep = enc->qstep;
+
+    for(i = 0; i < count; i++)
+    {
+        cur = (ab[i >> 2] >> ((i & 3) << 1)) & 0x03;
+        qstep += encoder_table[(last << 2) | cur];
+        last = cur;
+    }
+
+    enc->qstep   = qstep;
+    enc->ab_last = last;
+}
+
+/**
+ * @brief 获得编码器累计格数
+ * @param enc 编码器对象指针
+ * @return 累计格数，顺时针为正
+ */
+int32_t MTEncoderPositionGet(MT_ENCODER *enc)
+{
+    return enc->position;
+}
+
+/**
+ * @brief 获得编码器转速
+ * @param enc 编码器对象指针
+ * @return 转速(格/秒)，超过MT_ENCODER_IDLE_MS无步进时为0
+ */
+uint16_t MTEncoderVelocityGet(MT_ENCODER *enc)
+{
+    if(sys_ms - enc->step_ms > MT_ENCODER_IDLE_MS)
+        return 0;
+    return enc->velocity;
+}
+
+/**
+ * @brief 获得按转速加速后的累计格数并清零，适用于调节数值时快速旋转大幅变化
+ * @param enc 编码器对象指针
+ * @return 自上次读取以来加速后的格数，顺时针为正
+ */
+int16_t MTEncoderDeltaGet(MT_ENCODER *enc)
+{
+    int16_t delta    = enc->accel_delta;
+    enc->accel_delta = 0;
+    return delta;
+}
+
+/**
+ * @brief 编码器驱动，将累计的四分之一步换算为格数，更新转速并逐格上报STEP_CW/STEP_CCW
+ * @param enc 编码器对象指针
+ */
+static void MTEncoderHandler(MT_ENCODER *enc)
+{
+    MT_BUTTON *handle = &enc->Btn;
+    int16_t    steps;
+    uint16_t   num;
+    uint32_t   dt;
+    int32_t    delta;
+    uint8_t    accel;
+
+    if(enc->hal_encoder_AB)
+        MTEncoderSample(enc, enc->hal_encoder_AB(handle->button_id));
+
+    steps = (int16_t)(enc->qstep - enc->qstep_done) / (int16_t)enc->detent;
+    if(steps == 0)
+        return;
+    enc->qstep_done += steps * (int16_t)enc->detent;
+    enc->position += steps;
+
+    /* 转速与加速 */
+    num = (steps > 0) ? (uint16_t)steps : (uint16_t)(-steps);
+    dt  = sample_ms - enc->step_ms;
+    if(dt == 0)
+        dt = 1;
+    enc->velocity = (dt > MT_ENCODER_IDLE_MS) ? 0 : (uint16_t)(((uint32_t)num * 1000u) / dt);
+    enc->step_ms  = sample_ms;
+
+    accel = 1 + enc->velocity / MT_ENCODER_ACCEL_VEL;
+    if(accel > MT_ENCODER_ACCEL_MAX)
+        accel = MT_ENCODER_ACCEL_MAX;
+    delta = (int32_t)enc->accel_delta + (int32_t)steps * accel;
+    if(delta > INT16_MAX)
+        delta = INT16_MAX;
+    if(delta < INT16_MIN)
+        delta = INT16_MIN;
+    enc->accel_delta = (int16_t)delta;
+
+    while(num--)
+    {
+        EVENT_CB((steps > 0) ? STEP_CW : STEP_CCW);
+    }
+}
+
+/**
+ * @brief 保存工作列表中全部按钮的状态快照，用于深度睡眠前写入备份寄存器或保持RAM
+ *        格式: 版本(1) 数量(1) 时基(4,小端) 每按钮[ID(1) 状态|连击|电平(1) tick计数(2,小端)] 校验和(1)
+ * @param buf 快照缓冲
+ * @param size 缓冲大小，需不小于MT_BUTTON_SNAP_SIZE(按钮数)
+ * @return 快照字节数. 0: 缓冲不足或按钮数超过255
+ */
+uint16_t MTButtonSnapshot(uint8_t *buf, uint16_t size)
 {
     MT_BUTTON *target;
+    uint16_t   num = 0;
+    uint16_t   pos, i;
+    uint8_t    sum = 0;
+
+    for(target = head_handle; target; target = target->next)
+        num++;
+    if(num > 255 || size < MT_BUTTON_SNAP_SIZE(num))
+        return 0;
+
+    buf[0] = MT_BUTTON_SNAP_VER;
+    buf[1] = (uint8_t)num;
+    buf[2] = (uint8_t)(sys_ms);
+    buf[3] = (uint8_t)(sys_ms >> 8);
+    buf[4] = (uint8_t)(sys_ms >> 16);
+    buf[5] = (uint8_t)(sys_ms >> 24);
+    pos    = 6;
     for(target = head_handle; target; target = target->next)
     {
-        MTButtonHandler(target, cycle);
+        buf[pos++] = target->button_id;
+        buf[pos++] = (uint8_t)(target->state | (target->repeat << 3) | (target->button_level << 7));
+        buf[pos++] = (uint8_t)(target->ticks);
+        buf[pos++] = (uint8_t)(target->ticks >> 8);
+    }
+
+    for(i = 0; i < pos; i++)
+        sum += buf[i];
+    buf[pos++] = sum;
+    return pos;
+}
+
+/**
+ * @brief 唤醒后从快照恢复按钮状态，需在以睡眠前相同的顺序重新MTButtonInit与MTButtonStart之后、首次MTButtonTicks之前调用
+ *        记录按工作列表的顺序逐个对应，并校验ID，ID可重复
+ *        进行中的按键流程计入睡眠时间后继续；当前电平与快照不同的按钮视唤醒源为有效边沿，立即确立而无需再次消抖，
+ *        使唤醒按键的首次单击/长按被正确判定
+ * @param buf 快照
+ * @param len 快照字节数
+ * @param sleep_ms 睡眠经过的时间(Ms)
+ * @return 恢复的按钮个数. 0: 版本或校验不符，或工作列表的数量、ID顺序与快照不一致(此时不做任何恢复)
+ */
+uint8_t MTButtonResume(const uint8_t *buf, uint16_t len, uint32_t sleep_ms)
+{
+    MT_BUTTON *target;
+    uint16_t   pos, i;
+    uint8_t    sum = 0;
+    uint8_t    num, found = 0;
+    uint32_t   ticks;
+    uint8_t    level;
+
+    if(len < MT_BUTTON_SNAP_SIZE(0) || buf[0] != MT_BUTTON_SNAP_VER || len < MT_BUTTON_SNAP_SIZE(buf[1]))
+        return 0;
+    num = buf[1];
+    for(i = 0; i < MT_BUTTON_SNAP_SIZE(num) - 1; i++)
+        sum += buf[i];
+    if(sum != buf[MT_BUTTON_SNAP_SIZE(num) - 1])
+        return 0;
+
+    /* 快照按工作列表顺序写入，唤醒后以相同顺序启动即一一对应 */
+    for(pos = 6, target = head_handle; target; target = target->next, pos += 4)
+    {
+        if(found == num || target->button_id != buf[pos])
+            return 0;
+        found++;
+    }
+    if(found != num)
+        return 0;
+
+    sys_ms = (uint32_t)buf[2] | ((uint32_t)buf[3] << 8) | ((uint32_t)buf[4] << 16) | ((uint32_t)buf[5] << 24);
+    sys_ms += sleep_ms;
+    sample_ms = sys_ms;
+
+    for(pos = 6, target = head_handle; target; target = target->next, pos += 4)
+    {
+        target->state        = buf[pos + 1] & 0x07;
+        target->repeat       = (buf[pos + 1] >> 3) & 0x0F;
+        target->button_level = (buf[pos + 1] >> 7) & 0x01;
+        target->debounce_cnt = 0;
+        target->eager_down   = 0;
+
+        ticks = (uint32_t)buf[pos + 2] | ((uint32_t)buf[pos + 3] << 8);
+        if(target->state > 0)
+            ticks += sleep_ms;
+        target->ticks = (ticks > 0xFFFF) ? 0xFFFF : (uint16_t)ticks;
+
+        /* 由剩余的tick计数推回边沿时间戳 */
+        if(target->state == 2)
+        {
+            target->release_ms = sys_ms - target->ticks;
+            target->press_ms   = target->release_ms;
+        }
+        else if(target->state > 0)
+        {
+            target->press_ms = sys_ms - target->ticks;
+        }
+
+        /* 唤醒源视为已消抖的边沿 */
+        if(target->hal_button_Level)
+        {
+            level = target->hal_button_Level(target->button_id);
+            if(level != target->button_level)
+            {
+                if(level == target->active_level)
+                    target->press_ms = sys_ms;
+                else
+                    target->release_ms = sys_ms;
+                target->button_level = level;
+            }
+        }
+
+        if(target->is_encoder && ((MT_ENCODER *)target)->hal_encoder_AB)
+        { /* 以当前相位为起点，避免产生虚假步进 */
+            MT_ENCODER *enc = (MT_ENCODER *)target;
+            enc->ab_last    = enc->hal_encoder_AB(target->button_id) & 0x03;
+        }
+
+#if MT_BUTTON_USE_WHEEL
+        target->wheel_ms = sys_ms;
+        MTButtonNotify(target);
+#endif
+    }
+    return found;
+}
+
+/**
+ * @brief 依据确立边沿时的观测调整消抖周期数
+ *        被滤除的抖动逼近窗口或相邻边沿间隔过短(抖动被误确立)时立即加大窗口，
+ *        连续多个边沿留有余量时缩小窗口，从而收敛到该按键最小的安全消抖窗口并跟随触点磨损
+ * @param handle 按钮对象指针
+ * @param edge_ms 本次边沿的时间戳(Ms)
+ */
+static void MTButtonDebounceTune(MT_BUTTON *handle, uint32_t edge_ms)
+{
+    uint8_t  cnts     = handle->ConfMs.DebounceCnts;
+    uint8_t  required = handle->bounce_max + 1 + MT_BUTTON_ADAPT_MARGIN;
+    uint32_t last_ms  = (handle->button_level == handle->active_level) ? handle->press_ms : handle->release_ms;
+
+    if(edge_ms - last_ms < MT_BUTTON_ADAPT_GLITCH_MS || cnts < required)
+    { /* 余量不足 */
+        if(cnts < handle->adapt_max)
+            cnts++;
+        handle->adapt_calm = 0;
+    }
+    else if(cnts > required)
+    { /* 留有余量 */
+        if(++(handle->adapt_calm) >= MT_BUTTON_ADAPT_CALM_EDGES)
+        {
+            if(cnts > handle->adapt_min)
+                cnts--;
+            handle->adapt_calm = 0;
+        }
+    }
+    else
+    {
+        handle->adapt_calm = 0;
+    }
+
+    handle->ConfMs.DebounceCnts = cnts;
+    handle->bounce_max          = 0;
+}
+
+/**
+ * @brief 设置自适应消抖，运行中测量按键的抖动并在上下限之内收敛到最小的安全消抖周期数
+ * @param handle 按钮对象指针
+ * @param MinCnts 消抖周期数下限，不足1+MT_BUTTON_ADAPT_MARGIN时取该值(窗口至少比最短抖动多出余量，更小的值不可能收敛到)
+ * @param MaxCnts 消抖周期数上限，最大MT_BUTTON_DEBOUNCE_MAX；MinCnts与MaxCnts均为0时关闭自适应，保持当前值
+ */
+void MTButtonDebounceAdapt(MT_BUTTON *handle, uint8_t MinCnts, uint8_t MaxCnts)
+{
+    if(MinCnts == 0 && MaxCnts == 0)
+    {
+        handle->adapt_en = 0;
+        return;
+    }
+
+    if(MaxCnts > MT_BUTTON_DEBOUNCE_MAX)
+        MaxCnts = MT_BUTTON_DEBOUNCE_MAX;
+    if(MinCnts < 1 + MT_BUTTON_ADAPT_MARGIN)
+        MinCnts = 1 + MT_BUTTON_ADAPT_MARGIN;
+    if(MinCnts > MaxCnts)
+        MinCnts = MaxCnts;
+
+    handle->adapt_min  = MinCnts;
+    handle->adapt_max  = MaxCnts;
+    handle->adapt_calm = 0;
+    handle->bounce_max = 0;
+    handle->adapt_en   = 1;
+
+    if(handle->ConfMs.DebounceCnts < MinCnts)
+        handle->ConfMs.DebounceCnts = MinCnts;
+    if(handle->ConfMs.DebounceCnts > MaxCnts)
+        handle->ConfMs.DebounceCnts = MaxCnts;
+}
+
+/**
+ * @brief 导出校准后的消抖值，可存入Flash或备份寄存器，重启后经MTButtonDebounceImport恢复
+ * @param handle 按钮对象指针
+ * @return 校准值，bit7为有效标志，低4位为消抖周期数
+ */
+uint8_t MTButtonDebounceExport(MT_BUTTON *handle)
+{
+    return 0x80 | (handle->ConfMs.DebounceCnts & 0x0F);
+}
+
+/**
+ * @brief 导入MTButtonDebounceExport导出的校准值，无效值(如擦除后的0xFF)被忽略
+ *        自适应开启时按其上下限钳位，并继续在此基础上调整
+ * @param handle 按钮对象指针
+ * @param calib 校准值
+ */
+void MTButtonDebounceImport(MT_BUTTON *handle, uint8_t calib)
+{
+    uint8_t cnts = calib & 0x0F;
+
+    if((calib & 0xF0) != 0x80 || cnts == 0)
+        return;
+
+    if(handle->adapt_en)
+    {
+        if(cnts < handle->adapt_min)
+            cnts = handle->adapt_min;
+        if(cnts > handle->adapt_max)
+            cnts = handle->adapt_max;
+    }
+    handle->ConfMs.DebounceCnts = cnts;
+}
+
+/**
+ * @brief 批量输入单个按钮的一段连续原始采样，结果与逐周期调用MTButtonTicks完全一致
+ *        适用于调度延迟或经UART/CAN成批到达的远程按键电平；以此驱动的按钮不应MTButtonStart
+ *        不推进时基，最后一个采样对应当前时基，此前各采样的事件时间戳依次回溯；
+ *        无MTButtonTicks驱动时，由调用者对每段采样调用一次MTButtonTimeAdvance(count*period_ms)后再输入各按钮
+ * @param handle 按钮对象指针
+ * @param levels 按位紧凑排列的采样，第i个采样为levels[i/8]的bit(i%8)
+ * @param count 采样个数
+ * @param period_ms 采样周期值Ms
+ */
+void MTButtonFeedSamples(MT_BUTTON *handle, const uint8_t *levels, uint16_t count, uint8_t period_ms)
+{
+    uint16_t i = 0;
+
+    if(count == 0)
+        return;
+
+    sample_ms = sys_ms - (uint32_t)(count - 1) * period_ms;
+    while(i < count)
+    {
+        if((i & 7) == 0 && count - i >= 8 && handle->state == 0 && handle->debounce_cnt == 0 &&
+           handle->button_level != handle->active_level && levels[i >> 3] == (handle->button_level ? 0xFF : 0x00))
+        { /* 空闲且整字节电平无变化，状态机不会推进，整体跳过 */
+            handle->event = (uint8_t)NONE_PRESS;
+            i += 8;
+            sample_ms += (uint32_t)8 * period_ms;
+            continue;
+        }
+        handle->emitted = 0;
+        MTButtonHandler(handle, (levels[i >> 3] >> (i & 7)) & 1, period_ms);
+        i++;
+        sample_ms += period_ms;
+    }
+    sample_ms = sys_ms;
+    MTButtonSinkPoll( );
+}
+
+/**
+ * @brief 批量输入一组按钮的一段连续原始采样，结果与逐周期调用MTButtonTicks完全一致
+ *        以此驱动的按钮不应MTButtonStart；不推进时基，最后一个采样对应当前时基，推进方式同MTButtonFeedSamples
+ * @param handles 按钮对象指针数组
+ * @param num 按钮个数，最大32
+ * @param masks 采样数组，masks[i]的bit j为第i个采样时handles[j]的电平
+ * @param count 采样个数
+ * @param period_ms 采样周期值Ms
+ */
+void MTButtonFeedGroup(MT_BUTTON *const *handles, uint8_t num, const uint32_t *masks, uint16_t count, uint8_t period_ms)
+{
+    uint16_t i;
+    uint8_t  j;
+
+    if(count == 0)
+        return;
+
+    sample_ms = sys_ms - (uint32_t)(count - 1) * period_ms;
+    for(i = 0; i < count; i++)
+    {
+        for(j = 0; j < num && j < 32; j++)
+        {
+            handles[j]->emitted = 0;
+            MTButtonHandler(handles[j], (uint8_t)((masks[i] >> j) & 1), period_ms);
+        }
+        sample_ms += period_ms;
+    }
+    sample_ms = sys_ms;
+    MTButtonSinkPoll( );
+}
+
+/**
+ * @brief 通知按钮电平可能已变化，时间轮模式下使其在下次tick被处理，非时间轮模式下无作用
+ *        仅可对已启动的按钮调用，且不可在中断中调用
+ * @param handle 按钮对象指针
+ */
+void MTButtonNotify(MT_BUTTON *handle)
+{
+#if MT_BUTTON_USE_WHEEL
+    if(handle->wheel_pprev == &wheel_running)
+    { /* 本次tick正在处理，标记后由处理结束时安排 */
+        handle->wheel_due = wheel_now + 1;
+        return;
+    }
+    if(handle->wheel_pprev && handle->wheel_due == wheel_now + 1)
+        return; /* 已排在下次tick */
+    MTButtonWheelUnlink(handle);
+    MTButtonWheelInsert(handle, 1);
+#else
+    (void)handle;
+#endif
+}
+
+/**
+ * @brief 通知ID为button_id的全部已启动按钮电平可能已变化，用于只掌握按钮ID的输入后端
+ *        时间轮模式下遍历工作列表，非时间轮模式下无作用；不可在中断中调用
+ * @param button_id 按钮ID
+ */
+void MTButtonNotifyId(uint8_t button_id)
+{
+#if MT_BUTTON_USE_WHEEL
+    MT_BUTTON *target;
+    for(target = head_handle; target; target = target->next)
+    {
+        if(target->button_id == button_id)
+            MTButtonNotify(target);
+    }
+#else
+    (void)button_id;
+#endif
+}
+
+/**
+ * @brief 判断工作列表中的按钮是否全部空闲，空闲期间省略MTButtonTicks不会影响事件判定
+ * @return 1: 全部空闲，直到电平变化前无需tick. 0: 存在进行中的消抖或按键流程，或待投递的汇聚记录
+ */
+uint8_t MTButtonIsIdle(void)
+{
+    MT_BUTTON *target;
+    if(event_sink && sink_num)
+        return 0; /* 批量窗口未到期的记录需tick投递 */
+    for(target = head_handle; target; target = target->next)
+    {
+        if(target->state != 0 || target->debounce_cnt != 0)
+            return 0;
+        if(target->hal_button_Level && target->hal_button_Level(target->button_id) != target->button_level)
+            return 0;
+        if(target->is_encoder)
+        { /* 由tick采样的编码器需持续tick，由中断采样的编码器在有未上报步进时需tick */
+            MT_ENCODER *enc = (MT_ENCODER *)target;
+            if(enc->hal_encoder_AB || (int16_t)(enc->qstep - enc->qstep_done) / (int16_t)enc->detent != 0)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+#if MT_BUTTON_USE_WHEEL
+/**
+ * @brief 将按钮从时间轮中摘下
+ * @param handle 按钮对象指针
+ */
+static void MTButtonWheelUnlink(MT_BUTTON *handle)
+{
+    if(handle->wheel_pprev == NULL)
+        return;
+    if(handle->wheel_pprev == &wheel_running)
+    { /* 处理中的按钮被停止，仅作标记，保留处理链 */
+        handle->wheel_pprev = NULL;
+        return;
+    }
+    *handle->wheel_pprev = handle->wheel_next;
+    if(handle->wheel_next)
+        handle->wheel_next->wheel_pprev = handle->wheel_pprev;
+    handle->wheel_next  = NULL;
+    handle->wheel_pprev = NULL;
+}
+
+/**
+ * @brief 将按钮挂入时间轮
+ * @param handle 按钮对象指针，需未在时间轮中
+ * @param wait 距今的tick数，至少为1
+ */
+static void MTButtonWheelInsert(MT_BUTTON *handle, uint32_t wait)
+{
+    MT_BUTTON **slot;
+
+    handle->wheel_due = wheel_now + wait;
+    slot              = &wheel_slot[handle->wheel_due & (MT_BUTTON_WHEEL_SLOTS - 1)];
+
+    handle->wheel_next  = *slot;
+    handle->wheel_pprev = slot;
+    if(*slot)
+        (*slot)->wheel_pprev = &handle->wheel_next;
+    *slot = handle;
+}
+
+/**
+ * @brief 计算按钮下次需要处理的tick数，与状态机的各阈值判断一一对应
+ * @param handle 按钮对象指针
+ * @param cycle 周期值Ms
+ * @return 距今的tick数，0表示无期限，仅等待输入通知
+ */
+static uint32_t MTButtonWheelWait(MT_BUTTON *handle, uint8_t cycle)
+{
+    uint32_t target;
+
+    if(handle->debounce_cnt != 0 || cycle == 0 || handle->is_encoder)
+        return 1; /* 消抖进行中或编码器需逐周期采样 */
+
+    switch(handle->state)
+    {
+    case 0:
+        return (handle->button_level == handle->active_level) ? 1 : 0;
+    case 1: /* 短按阈值(相等判断)与长按阈值(大于判断)中较早者 */
+        target = (uint32_t)handle->ConfMs.LongTicks + 1;
+        if(handle->ticks < handle->ConfMs.ShortTicks && handle->ConfMs.ShortTicks < target)
+            target = handle->ConfMs.ShortTicks;
+        break;
+    case 2:
+    case 3:
+        target = (uint32_t)handle->ConfMs.ShortTicks + 1;
+        break;
+    default: /* 长按保持期间每周期触发 */
+        return 1;
+    }
+
+    if(handle->ticks >= target)
+        return 1;
+    return (target - handle->ticks + cycle - 1) / cycle;
+}
+
+/**
+ * @brief 推进时间轮一个tick，仅处理到期的按钮并重新安排其期限
+ * @param cycle 周期值Ms
+ */
+static void MTButtonWheelRun(uint8_t cycle)
+{
+    MT_BUTTON **curr;
+    MT_BUTTON  *target;
+    MT_BUTTON  *run = NULL;
+    uint32_t    elapsed;
+    uint32_t    wait;
+
+    wheel_now++;
+
+    /* 先摘下本槽中到期的按钮组成处理链，处理过程中可能重新挂入同一槽 */
+    for(curr = &wheel_slot[wheel_now & (MT_BUTTON_WHEEL_SLOTS - 1)]; *curr;)
+    {
+        target = *curr;
+        if(target->wheel_due == wheel_now)
+        {
+            MTButtonWheelUnlink(target);
+            target->wheel_next  = run;
+            target->wheel_pprev = &wheel_running;
+            run                 = target;
+        }
+        else
+        {
+            curr = &target->wheel_next;
+        }
+    }
+
+    while(run)
+    {
+        target             = run;
+        run                = target->wheel_next;
+        target->wheel_next = NULL;
+        if(target->wheel_pprev == NULL)
+            continue; /* 已在其他按钮的回调中被停止 */
+
+        elapsed          = sys_ms - target->wheel_ms;
+        target->wheel_ms = sys_ms;
+        MTButtonProcess(target, (elapsed > 0xFFFF) ? 0xFFFF : (uint16_t)elapsed);
+
+        if(target->wheel_pprev == NULL)
+            continue; /* 回调中被停止 */
+        target->wheel_pprev = NULL;
+
+        wait = (target->wheel_due != wheel_now) ? 1 : MTButtonWheelWait(target, cycle); /* 回调中被通知 */
+        if(wait)
+            MTButtonWheelInsert(target, wait);
     }
 }
+#endif
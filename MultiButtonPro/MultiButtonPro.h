@@ -18,8 +18,34 @@ extern "C"
 #include <stdint.h>
 #include <string.h>
 /* Exported constants --------------------------------------------------------*/
+
+/* 1: 以哈希时间轮调度按钮，每次tick仅处理阈值到期或有新输入的按钮，适合大量(虚拟)按钮
+      此模式下按钮电平变化时必须调用MTButtonNotify，且MTButtonTicks的周期值需保持恒定 */
+#ifndef MT_BUTTON_USE_WHEEL
+#define MT_BUTTON_USE_WHEEL 0
+#endif
+#ifndef MT_BUTTON_WHEEL_SLOTS
+#define MT_BUTTON_WHEEL_SLOTS 256 /* 时间轮槽数，需为2的幂，宜大于 长按阈值/周期值 */
+#endif
+#if MT_BUTTON_USE_WHEEL && (MT_BUTTON_WHEEL_SLOTS <= 0 || (MT_BUTTON_WHEEL_SLOTS & (MT_BUTTON_WHEEL_SLOTS - 1)) != 0)
+#error "MT_BUTTON_WHEEL_SLOTS must be a power of two"
+#endif
+
+#define MT_BUTTON_DEBOUNCE_MAX     15 /* 消抖周期数上限，由debounce_cnt的位宽决定 */
+#define MT_BUTTON_ADAPT_MARGIN     1  /* 自适应消抖：在观测到的最长抖动之上保留的余量(周期数) */
+#define MT_BUTTON_ADAPT_CALM_EDGES 8  /* 自适应消抖：连续多少个留有余量的边沿后缩小一个周期 */
+#define MT_BUTTON_ADAPT_GLITCH_MS  20 /* 自适应消抖：相邻两边沿间隔小于此值(Ms)视为抖动被误确立 */
+
+#define MT_BUTTON_SNAP_VER     1                  /* 状态快照格式版本 */
+#define MT_BUTTON_SNAP_SIZE(n) (7 + 4 * (n))      /* n个按钮的状态快照字节数 */
+
+#define MT_ENCODER_IDLE_MS   200 /* 编码器超过此时间(Ms)无步进则转速归零 */
+#define MT_ENCODER_ACCEL_VEL 10  /* 编码器加速：转速(格/秒)每达此值，每格增加1倍计数 */
+#define MT_ENCODER_ACCEL_MAX 8   /* 编码器加速：最大倍数 */
 /* Exported macros -----------------------------------------------------------*/
 
+#define MT_BUTTON_EVENT_MASK(ev) (1u << (ev)) /* 事件值对应的订阅掩码位 */
+
 /* Exported types ------------------------------------------------------------*/
 typedef void (*BtnCallback)(void *);
 
@@ -37,6 +63,9 @@ typedef enum
     SHORT_PRESS_START, // 达到短按时间阈值时触发一次
     LONG_PRESS_START,  // 达到长按时间阈值时触发一次
     LONG_PRESS_HOLD,   // 长按期间一直触发
+    PRESS_CANCEL,      // 提前上报的按下未能通过消抖，撤销之前的PRESS_DOWN(仅EagerPress模式)
+    STEP_CW,           // 编码器顺时针转过一格，每格触发一次
+    STEP_CCW,          // 编码器逆时针转过一格，每格触发一次
     MUTLTIB_EVENT_MAX,
     NONE_PRESS
 } PressEvent;
@@ -46,11 +75,24 @@ typedef enum
  */
 typedef struct
 {
-    uint8_t  DebounceCnts; // (周期数) 消抖稳定周期值 依据debounce_cnt位确立最大值，目前是7
+    uint8_t  DebounceCnts; // (周期数) 消抖稳定周期值 依据debounce_cnt位确立最大值MT_BUTTON_DEBOUNCE_MAX
+    uint8_t  EagerPress;   // 非0时首个按下采样即上报PRESS_DOWN，未通过消抖则补发PRESS_CANCEL
     uint16_t ShortTicks;   // (Ms) 短按判定阈值
     uint16_t LongTicks;    // (Ms) 长按判定阈值
 } MT_BUTTON_CONF;
 
+/**
+ * @brief 事件附带的时间信息，由MTButtonEventInfoGet获得
+ */
+typedef struct
+{
+    uint32_t TimeMs;     // (Ms) 事件时间戳，边沿类事件已按消抖窗口回溯到实际边沿时刻
+    uint32_t DurationMs; // (Ms) 本次按下的持续时间，按下期间为至事件时刻的已按时长
+    uint8_t  Event;      // 事件值 PressEvent
+    uint8_t  Repeat;     // 连击计数
+    uint8_t  ButtonId;   // 按钮ID号
+} MT_BUTTON_EVENT_INFO;
+
 /**
  * @brief MultiButton库的对象结构体
  */
@@ -61,29 +103,129 @@ typedef struct MT_BUTTON
     uint8_t        repeat      :4;                   // 连击计数器
     uint8_t        event       :4;                   // 事件寄存器
     uint8_t        state       :3;                   // 驱动状态机寄存器
-    uint8_t        debounce_cnt:3;                   // 消抖计数器(非Ms单位，以周期为单位)
+    uint8_t        debounce_cnt:4;                   // 消抖计数器(非Ms单位，以周期为单位)
     uint8_t        active_level:1;                   // 按下电平返回值绑定
     uint8_t        button_level:1;                   // 当前按钮确立值
+    uint8_t        adapt_en    :1;                   // 自适应消抖使能
+    uint8_t        is_encoder  :1;                   // 本对象为MT_ENCODER的按钮部分
+    uint8_t        eager_down  :1;                   // 已提前上报PRESS_DOWN，等待消抖确立
+    uint8_t        emitted     :1;                   // 本次处理中已产生事件，空闲时不清除事件寄存器
+    uint8_t        adapt_min   :4;                   // 自适应消抖下限(周期数)
+    uint8_t        adapt_max   :4;                   // 自适应消抖上限(周期数)
+    uint8_t        bounce_max  :4;                   // 自上个边沿以来被滤除的最长抖动(周期数)
+    uint8_t        adapt_calm  :4;                   // 连续留有余量的边沿计数
     uint8_t        button_id;                        // 按钮ID号
     uint8_t (*hal_button_Level)(uint8_t button_id_); // 按钮电平获得函数，需要返回0或1
+    uint32_t          press_ms;                      // 最近一次按下边沿时间戳(Ms)
+    uint32_t          release_ms;                    // 最近一次释放边沿时间戳(Ms)
+    uint32_t          event_ms;                      // 事件寄存器对应的时间戳(Ms)
     BtnCallback       cb[MUTLTIB_EVENT_MAX];         // 事件回调组
     struct MT_BUTTON *next;
+#if MT_BUTTON_USE_WHEEL
+    uint32_t           wheel_due;   // 时间轮到期的tick序号
+    uint32_t           wheel_ms;    // 上次处理时的时基(Ms)
+    struct MT_BUTTON  *wheel_next;  // 时间轮槽链
+    struct MT_BUTTON **wheel_pprev; // 非NULL表示已挂入时间轮
+#endif
 } MT_BUTTON;
+
+/**
+ * @brief 全局事件钩子，任一按钮产生事件时在其回调之后调用，用于上层封装
+ */
+typedef void (*MTButtonHook)(MT_BUTTON *handle, PressEvent event);
+
+/**
+ * @brief 事件汇聚记录，合并的事件以首个事件的时间戳为准
+ */
+typedef struct
+{
+    uint32_t TimeMs;     // (Ms) 事件时间戳，合并时为首个事件的时间戳
+    uint32_t DurationMs; // (Ms) 按下持续时间，合并时为最后一个事件的值
+    uint16_t Count;      // 合并的事件个数，未合并时为1
+    uint8_t  Event;      // 事件值 PressEvent
+    uint8_t  ButtonId;   // 按钮ID号
+} MT_BUTTON_RECORD;
+
+typedef void (*MTButtonSinkFn)(const MT_BUTTON_RECORD *recs, uint16_t num);
+
+/**
+ * @brief 组级事件汇聚配置，全部按钮的订阅事件写入记录缓冲并整批投递，用于日志、遥测转发
+ */
+typedef struct
+{
+    MT_BUTTON_RECORD *Buf;          // 记录缓冲
+    uint16_t          Size;         // 缓冲可容纳的记录数
+    uint16_t          Mask;         // 订阅的事件掩码，见MT_BUTTON_EVENT_MASK
+    uint16_t          CoalesceMask; // 需合并的事件掩码，同一按钮连续的同类事件合并为一条并计数
+    uint16_t          WindowMs;     // (Ms) 批量窗口，首条记录缓存达此时间或缓冲满时整批投递；0为每次tick投递
+    MTButtonSinkFn    Deliver;      // 批量投递函数
+} MT_BUTTON_SINK;
+
+/**
+ * @brief 正交旋转编码器对象，内嵌按钮对象共用工作列表与MTButtonTicks，推压开关使用按钮部分的事件
+ */
+typedef struct MT_ENCODER
+{
+    MT_BUTTON Btn;                                   // 按钮部分(需为首个成员)，STEP_CW/STEP_CCW也经其回调组上报
+    uint8_t (*hal_encoder_AB)(uint8_t encoder_id_); // A/B相电平获得函数，返回(A<<1)|B；为NULL时仅由高速采样接口输入
+    volatile int16_t qstep;                          // 采样端累计的四分之一步，仅采样端写入
+    int16_t          qstep_done;                     // tick端已换算为格数的四分之一步
+    uint8_t          ab_last:2;                      // 上次采样的A/B相
+    uint8_t          detent :3;                      // 每格的四分之一步数 1/2/4
+    int16_t          accel_delta;                    // 按转速加速后的累计格数，MTEncoderDeltaGet读取后清零
+    uint16_t         velocity;                       // (格/秒) 最近的转速
+    int32_t          position;                       // 累计格数，顺时针为正
+    uint32_t         step_ms;                        // 最近一次步进的时基(Ms)
+} MT_ENCODER;
 /* Exported variables ---------------------------------------------------------*/
 /* Exported functions ---------------------------------------------------------*/
 
-extern void       MTButtonInit(MT_BUTTON *handle,
-                               uint8_t (*pin_level)(uint8_t),
-                               uint8_t  active_level,
-                               uint8_t  button_id, /* 基础部分 */
-                               uint8_t  DebounceC,
-                               uint16_t ShortT,
-                               uint16_t LongT /* 拓展部分 */);
-extern void       MTButtonAttach(MT_BUTTON *handle, PressEvent event, BtnCallback cb);
-extern PressEvent MTButtonEventGet(MT_BUTTON *handle);
-extern uint32_t   MTButtonStart(MT_BUTTON *handle);
-extern void       MTButtonStop(MT_BUTTON *handle);
-extern void       MTButtonTicks(uint8_t cycle);
+extern void         MTButtonInit(MT_BUTTON *handle,
+                                 uint8_t (*pin_level)(uint8_t),
+                                 uint8_t  active_level,
+                                 uint8_t  button_id, /* 基础部分 */
+                                 uint8_t  DebounceC,
+                                 uint16_t ShortT,
+                                 uint16_t LongT /* 拓展部分 */);
+extern void         MTButtonAttach(MT_BUTTON *handle, PressEvent event, BtnCallback cb);
+extern MTButtonHook MTButtonHookSet(MTButtonHook hook);
+extern PressEvent   MTButtonEventGet(MT_BUTTON *handle);
+extern void         MTButtonEventInfoGet(MT_BUTTON *handle, MT_BUTTON_EVENT_INFO *info);
+extern uint32_t     MTButtonTimeGet(void);
+extern void         MTButtonTimeAdvance(uint32_t ms);
+extern uint8_t      MTButtonIsIdle(void);
+extern uint32_t     MTButtonStart(MT_BUTTON *handle);
+extern void         MTButtonStop(MT_BUTTON *handle);
+extern void         MTButtonTicks(uint8_t cycle);
+extern void         MTButtonNotify(MT_BUTTON *handle);
+extern void         MTButtonNotifyId(uint8_t button_id);
+extern void         MTEncoderInit(MT_ENCODER *enc,
+                                  uint8_t (*ab_level)(uint8_t),
+                                  uint8_t (*pin_level)(uint8_t),
+                                  uint8_t  active_level,
+                                  uint8_t  encoder_id,
+                                  uint8_t  StepsPerDetent, /* 基础部分 */
+                                  uint8_t  DebounceC,
+                                  uint16_t ShortT,
+                                  uint16_t LongT /* 推压开关部分 */);
+extern void         MTEncoderSample(MT_ENCODER *enc, uint8_t ab);
+extern void         MTEncoderFeedSamples(MT_ENCODER *enc, const uint8_t *ab, uint16_t count);
+extern int32_t      MTEncoderPositionGet(MT_ENCODER *enc);
+extern uint16_t     MTEncoderVelocityGet(MT_ENCODER *enc);
+extern int16_t      MTEncoderDeltaGet(MT_ENCODER *enc);
+extern uint16_t     MTButtonSnapshot(uint8_t *buf, uint16_t size);
+extern uint8_t      MTButtonResume(const uint8_t *buf, uint16_t len, uint32_t sleep_ms);
+extern void         MTButtonSinkSet(MT_BUTTON_SINK *sink);
+extern void         MTButtonSinkFlush(void);
+extern void         MTButtonDebounceAdapt(MT_BUTTON *handle, uint8_t MinCnts, uint8_t MaxCnts);
+extern uint8_t      MTButtonDebounceExport(MT_BUTTON *handle);
+extern void         MTButtonDebounceImport(MT_BUTTON *handle, uint8_t calib);
+extern void         MTButtonFeedSamples(MT_BUTTON *handle, const uint8_t *levels, uint16_t count, uint8_t period_ms);
+extern void         MTButtonFeedGroup(MT_BUTTON *const *handles,
+                                      uint8_t           num,
+                                      const uint32_t   *masks,
+                                      uint16_t          count,
+                                      uint8_t           period_ms);
 
 #ifdef __cplusplus
 }
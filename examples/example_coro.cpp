@@ -0,0 +1,73 @@
+#include "MultiButtonCoro.hpp"
+
+using namespace mtbutton;
+
+enum Button_IDs
+{
+    btn1_id,
+    btn2_id,
+};
+
+/**
+ * @brief 示例绑定的按钮电平获得函数(实际上是虚拟电平，只要是0或1即可)
+ * @param button_id 触发的按钮IO
+ * @return 电平0或1
+ */
+uint8_t read_button_GPIO(uint8_t button_id)
+{
+    // you can share the GPIO read function with multiple Buttons
+    switch(button_id)
+    {
+    case btn1_id:
+        return HAL_GPIO_ReadPin(B1_GPIO_Port, B1_Pin);
+    case btn2_id:
+        return HAL_GPIO_ReadPin(B2_GPIO_Port, B2_Pin);
+    default:
+        return 0;
+    }
+}
+
+Button btn1(read_button_GPIO, /* 按钮电平获得函数 */
+            0,                /* 按下有效电平 */
+            btn1_id,          /* 按钮对象ID */
+            5,                /* 电平建立有效周期，用于消抖*/
+            80,               /* 短按生效时间(Ms) */
+            1200);            /* 长按生效时间(Ms)*/
+Button btn2(read_button_GPIO, 0, btn2_id, 5, 80, 1200);
+
+/**
+ * @brief 菜单逻辑：长按进入设置，设置中双击确认，3秒无操作或任一按钮长按退出
+ */
+Task menu_task( )
+{
+    while(1)
+    {
+        auto ev = co_await btn1.next_event(on::LONG_CLICK | on::DOUBLE_CLICK);
+        if(ev.event != LONG_CLICK)
+            continue;
+
+        /* 进入设置 */
+        while(1)
+        {
+            auto any = co_await when_any(btn1.next_event(on::DOUBLE_CLICK | on::LONG_CLICK, 3000),
+                                         btn2.next_event(on::LONG_CLICK, 3000));
+            if(!any || any.event == LONG_CLICK)
+                break; /* 超时或长按，退出设置 */
+
+            // any.index == 0 : btn1 双击确认，any.info.TimeMs 为确认时刻
+        }
+    }
+}
+
+int main( )
+{
+    btn1.start( );
+    btn2.start( );
+    menu_task( );
+
+    while(1)
+    {
+        Executor::instance( ).tick(5); /* 替代 MTButtonTicks(5)，并恢复就绪的协程 */
+        delay(5ms);
+    }
+}
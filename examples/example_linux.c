@@ -0,0 +1,105 @@
+#include "MultiButtonLinux.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+enum Button_IDs
+{
+    btn1_id,
+};
+
+MT_BUTTON btn1;
+
+void BTN1_SINGLE_Click_Handler(void *btn)
+{
+    MT_BUTTON_EVENT_INFO info;
+    MTButtonEventInfoGet((MT_BUTTON *)btn, &info);
+    printf("single click @%lu ms, held %lu ms\n", (unsigned long)info.TimeMs, (unsigned long)info.DurationMs);
+}
+
+void BTN1_LONG_CLICK_Handler(void *btn)
+{
+    MT_BUTTON_EVENT_INFO info;
+    MTButtonEventInfoGet((MT_BUTTON *)btn, &info);
+    printf("long click @%lu ms, held %lu ms\n", (unsigned long)info.TimeMs, (unsigned long)info.DurationMs);
+}
+
+/**
+ * @brief 向替身fd写入一条合成的evdev按键记录
+ * @param fd 写端
+ * @param value 1按下 0释放
+ */
+static void write_key(int fd, int value)
+{
+    struct input_event ev = {0};
+    ev.type  = EV_KEY;
+    ev.code  = KEY_ENTER;
+    ev.value = value;
+    if(write(fd, &ev, sizeof(ev)) != (ssize_t)sizeof(ev))
+        _exit(1);
+}
+
+int main( )
+{
+    int   sv[2];
+    pid_t pid;
+
+    /* 实际使用时打开 /dev/input/eventX 或 GPIO 行事件fd，此处以socketpair替身写入合成记录 */
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        perror("socketpair");
+        return EXIT_FAILURE;
+    }
+
+    if(MTButtonLinuxInit(5) < 0 || MTButtonLinuxAdd(sv[0], MT_LINUX_EVDEV, KEY_ENTER, btn1_id, 0) < 0)
+    {
+        perror("MTButtonLinux");
+        return EXIT_FAILURE;
+    }
+
+    MTButtonInit(&btn1,              /* 按钮对象指针 */
+                 MTButtonLinuxLevel, /* 按钮电平获得函数 */
+                 1,                  /* 按下有效电平(evdev按下为1) */
+                 btn1_id,            /* 按钮对象ID */
+                 3,                  /* 电平建立有效周期，用于消抖*/
+                 200,                /* 短按生效时间(Ms) */
+                 1000);              /* 长按生效时间(Ms)*/
+    MTButtonAttach(&btn1, SINGLE_CLICK, BTN1_SINGLE_Click_Handler);
+    MTButtonAttach(&btn1, LONG_CLICK, BTN1_LONG_CLICK_Handler);
+    MTButtonStart(&btn1);
+
+    pid = fork( );
+    if(pid < 0)
+    {
+        perror("fork");
+        MTButtonLinuxDeinit( );
+        return EXIT_FAILURE;
+    }
+    if(pid == 0)
+    { /* 替身输入设备：一次单击，一次长按 */
+        write_key(sv[1], 1);
+        usleep(80 * 1000);
+        write_key(sv[1], 0);
+        usleep(600 * 1000);
+        write_key(sv[1], 1);
+        usleep(1500 * 1000);
+        write_key(sv[1], 0);
+        usleep(300 * 1000);
+        _exit(0);
+    }
+    close(sv[1]);
+
+    /* 全部按钮空闲时阻塞于此，无需忙轮询；替身退出且流程结束后返回MT_LINUX_NO_INPUT */
+    while(MTButtonLinuxPoll(-1) >= 0)
+    {
+    }
+
+    MTButtonLinuxDeinit( );
+    waitpid(pid, NULL, 0);
+    return 0;
+}